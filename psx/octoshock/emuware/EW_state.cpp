@@ -46,6 +46,133 @@ void NewStateExternalBuffer::Load(void *ptr, size_t size, const char *name)
 	length += size;
 }
 
+NewStateXorDelta::NewStateXorDelta(std::vector<unsigned char> &ref, std::vector<unsigned char> &out)
+	:ref(ref), out(out), length(0), pages(0), keyframe(ref.empty())
+{
+	DeltaHeader hdr = { MAGIC, keyframe ? (unsigned int)FLAG_KEYFRAME : 0, 0, 0 };
+	out.resize(sizeof(hdr));
+	std::memcpy(&out[0], &hdr, sizeof(hdr));
+}
+
+void NewStateXorDelta::EmitPage(const unsigned char *src, size_t pageidx, size_t size)
+{
+	const size_t refpos = pageidx * PAGE_SIZE;
+	if (keyframe)
+		ref.resize(refpos + size);
+	else if (refpos + size > ref.size())
+		return; //state grew past the reference; Finish() will report the mismatch
+
+	unsigned char *dst = &ref[refpos];
+	if (!keyframe && !std::memcmp(dst, src, size))
+		return;
+
+	pages++;
+	const size_t outpos = out.size();
+	const unsigned int idx = (unsigned int)pageidx;
+	out.resize(outpos + sizeof(idx) + size);
+	std::memcpy(&out[outpos], &idx, sizeof(idx));
+	unsigned char *x = &out[outpos + sizeof(idx)];
+	for (size_t i = 0; i < size; i++)
+	{
+		x[i] = dst[i] ^ src[i];
+		dst[i] = src[i];
+	}
+}
+
+void NewStateXorDelta::Save(const void *ptr, size_t size, const char *name)
+{
+	const unsigned char *src = static_cast<const unsigned char *>(ptr);
+	while (size)
+	{
+		const size_t pageofs = length % PAGE_SIZE;
+		if (pageofs == 0 && size >= PAGE_SIZE)
+		{
+			//whole pages compare straight from the live state without staging
+			EmitPage(src, length / PAGE_SIZE, PAGE_SIZE);
+			src += PAGE_SIZE;
+			size -= PAGE_SIZE;
+			length += PAGE_SIZE;
+			continue;
+		}
+
+		const size_t todo = std::min(size, (size_t)PAGE_SIZE - pageofs);
+		std::memcpy(page + pageofs, src, todo);
+		src += todo;
+		size -= todo;
+		length += todo;
+		if (length % PAGE_SIZE == 0)
+			EmitPage(page, length / PAGE_SIZE - 1, PAGE_SIZE);
+	}
+}
+
+void NewStateXorDelta::Load(void *ptr, size_t size, const char *name)
+{
+}
+
+bool NewStateXorDelta::Finish()
+{
+	if (length % PAGE_SIZE)
+		EmitPage(page, length / PAGE_SIZE, length % PAGE_SIZE);
+
+	if (length != ref.size())
+		return false;
+
+	DeltaHeader hdr;
+	std::memcpy(&hdr, &out[0], sizeof(hdr));
+	hdr.total_length = (unsigned int)length;
+	hdr.page_count = pages;
+	std::memcpy(&out[0], &hdr, sizeof(hdr));
+	return true;
+}
+
+bool NewStateXorDelta::Apply(std::vector<unsigned char> &ref, const void *delta, long deltalength)
+{
+	const unsigned char *src = static_cast<const unsigned char *>(delta);
+	DeltaHeader hdr;
+	if (deltalength < (long)sizeof(hdr))
+		return false;
+	std::memcpy(&hdr, src, sizeof(hdr));
+	if (hdr.magic != MAGIC)
+		return false;
+
+	const bool keyframe = (hdr.flags & FLAG_KEYFRAME) != 0;
+	if (!keyframe && hdr.total_length != ref.size())
+		return false;
+
+	//validate everything before touching the reference, so a bad delta leaves it intact
+	size_t pos = sizeof(hdr);
+	for (unsigned int i = 0; i < hdr.page_count; i++)
+	{
+		unsigned int idx;
+		if (pos + sizeof(idx) > (size_t)deltalength)
+			return false;
+		std::memcpy(&idx, src + pos, sizeof(idx));
+		if ((size_t)idx * PAGE_SIZE >= hdr.total_length)
+			return false;
+		pos += sizeof(idx) + std::min((size_t)PAGE_SIZE, hdr.total_length - (size_t)idx * PAGE_SIZE);
+	}
+	if (pos != (size_t)deltalength)
+		return false;
+
+	if (keyframe)
+		ref.assign(hdr.total_length, 0);
+
+	pos = sizeof(hdr);
+	for (unsigned int i = 0; i < hdr.page_count; i++)
+	{
+		unsigned int idx;
+		std::memcpy(&idx, src + pos, sizeof(idx));
+		pos += sizeof(idx);
+		const size_t size = std::min((size_t)PAGE_SIZE, hdr.total_length - (size_t)idx * PAGE_SIZE);
+		unsigned char *dst = &ref[(size_t)idx * PAGE_SIZE];
+		for (size_t j = 0; j < size; j++)
+			dst[j] ^= src[pos + j];
+		pos += size;
+	}
+
+	return true;
+}
+
 NewStateExternalFunctions::NewStateExternalFunctions(const FPtrs *ff)
 	:Save_(ff->Save_),
 	Load_(ff->Load_),
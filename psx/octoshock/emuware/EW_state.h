@@ -3,6 +3,7 @@
 
 #include <cstring>
 #include <cstddef>
+#include <vector>
 
 namespace EW
 {
@@ -43,6 +44,44 @@ namespace EW
 		virtual void Load(void *ptr, size_t size, const char *name);
 	};
 
+	// saves a page-granular XOR delta of the state against a reference image of the previous state, and updates the reference.
+	// since the delta is an XOR, applying it to either end of the pair yields the other end, so one delta serves to step forwards and backwards.
+	// delta layout: DeltaHeader, then for each changed page a u32 page index followed by the XORed page contents (the final page may be short)
+	class NewStateXorDelta : public NewState
+	{
+	public:
+		enum { PAGE_SIZE = 4096 };
+		enum { FLAG_KEYFRAME = 1 };
+		struct DeltaHeader
+		{
+			unsigned int magic;
+			unsigned int flags;
+			unsigned int total_length; // length of the full state the delta applies to
+			unsigned int page_count; // number of changed pages which follow
+		};
+		static const unsigned int MAGIC = 0x544C4458; // "XDLT"
+
+	private:
+		std::vector<unsigned char> &ref;
+		std::vector<unsigned char> &out;
+		unsigned char page[PAGE_SIZE];
+		size_t length;
+		unsigned int pages;
+		bool keyframe;
+		void EmitPage(const unsigned char *src, size_t pageidx, size_t size);
+	public:
+		//when the reference is empty the delta is taken against zeroes, and flagged as a keyframe
+		NewStateXorDelta(std::vector<unsigned char> &ref, std::vector<unsigned char> &out);
+		virtual void Save(const void *ptr, size_t size, const char *name);
+		virtual void Load(void *ptr, size_t size, const char *name);
+		//flushes the last partial page and finishes the header. returns false if the state length didnt match the reference
+		bool Finish();
+		long GetLength() { return (long)length; }
+
+		//XORs a delta into the reference (a keyframe replaces it). returns false if the delta is malformed or doesnt fit the reference
+		static bool Apply(std::vector<unsigned char> &ref, const void *delta, long deltalength);
+	};
+
 	struct FPtrs
 	{
 		void (*Save_)(const void *ptr, size_t size, const char *name);
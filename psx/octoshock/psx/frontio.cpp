@@ -691,6 +691,11 @@ SYNCFUNC(FrontIO)
 bool FrontIO::RequireNoFrameskip(void)
 {
 	//this whole function is nonsense. frontend should know what it has attached
+	//...but the threaded GPU needs to know whether a lightgun is going to look at the scanline pixels
+ for(unsigned i = 0; i < 2; i++)
+  if(Ports[i]->RequireNoFrameskip())
+   return(true);
+
  return(false);
 }
 
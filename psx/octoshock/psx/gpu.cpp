@@ -22,6 +22,10 @@
 #pragma GCC optimize ("unroll-loops")
 
 #include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include "psx.h"
 #include "timer.h"
@@ -129,7 +133,225 @@ void GPU_Init(bool pal_clock_and_tv)
 
 void GPU_Kill(void)
 {
+ GPU_SetThreaded(false);
+}
+
+//
+// Threaded rasterization.  Everything that writes VRAM(and the display readout, which reads it into the output surface) is
+// queued up here in command order and run by the raster thread via GPU_RasterExec(), against a snapshot of the drawing
+// state taken when the emulation thread ran the command.  The emulation thread still runs each command itself with
+// RasterDeferred set, which skips the pixel work but keeps DrawTimeAvail and the cache tags exactly as they'd be otherwise.
+//
+// Anything that wants to look at VRAM or the output surface on the emulation thread has to GPU_Sync() first.
+//
+static const uint32 RasterRingSize = 1024;
+static RasterCmd RasterRing[RasterRingSize];
+static std::atomic<uint32> RasterWritePos, RasterReadPos;
+static std::atomic<bool> RasterWorkerIdle, RasterWaiting;
+static bool RasterQuit;
+static RasterCmd *RasterStage;	// FB write data being batched up in the next ring slot, not yet visible to the raster thread.
+static std::mutex RasterMutex;
+static std::condition_variable RasterWorkCond, RasterDoneCond;
+static std::thread RasterThread;
+
+static void ReadoutLine(const uint16 *src, uint32 *dest, const MDFN_PixelFormat &format, bool bpp24, int32 dx_start, int32 dx_end, uint32 dmw, int32 fb_x, uint32 black);
+
+static void RasterThreadMain(void)
+{
+ for(;;)
+ {
+  const uint32 rp = RasterReadPos.load(std::memory_order_relaxed);
+
+  if(rp == RasterWritePos.load(std::memory_order_acquire))
+  {
+   std::unique_lock<std::mutex> lock(RasterMutex);
+
+   RasterWorkerIdle = true;
+   RasterWorkCond.wait(lock, [rp]{ return RasterQuit || rp != RasterWritePos.load(); });
+   RasterWorkerIdle = false;
+
+   if(rp == RasterWritePos.load())
+    return;
+
+   continue;
+  }
+
+  const RasterCmd &rc = RasterRing[rp % RasterRingSize];
 
+  if(rc.type == RasterCmd::TYPE_SCANOUT)
+   ReadoutLine(rc.scanout.src, rc.scanout.dest, *rc.scanout.format, rc.scanout.bpp24, rc.scanout.dx_start, rc.scanout.dx_end, rc.scanout.dmw, rc.scanout.fb_x, rc.scanout.black);
+  else
+   GPU_RasterExec(rc);
+
+  RasterReadPos = rp + 1;
+
+  if(RasterWaiting)
+  {
+   std::lock_guard<std::mutex> lock(RasterMutex);
+   RasterDoneCond.notify_all();
+  }
+ }
+}
+
+// Waits until the raster thread has finished with everything before ring position pos.
+static void RasterWaitFor(const uint32 pos)
+{
+ if((int32)(RasterReadPos - pos) >= 0)
+  return;
+
+ std::unique_lock<std::mutex> lock(RasterMutex);
+
+ RasterWaiting = true;
+ RasterDoneCond.wait(lock, [pos]{ return (int32)(RasterReadPos - pos) >= 0; });
+ RasterWaiting = false;
+}
+
+static void RasterCommit(void)
+{
+ RasterWritePos = RasterWritePos.load(std::memory_order_relaxed) + 1;
+
+ if(RasterWorkerIdle)
+ {
+  std::lock_guard<std::mutex> lock(RasterMutex);
+  RasterWorkCond.notify_one();
+ }
+}
+
+static INLINE void RasterFlushStage(void)
+{
+ if(RasterStage)
+ {
+  RasterStage = NULL;
+  RasterCommit();
+ }
+}
+
+static RasterCmd* RasterAlloc(void)
+{
+ RasterFlushStage();
+
+ const uint32 wp = RasterWritePos.load(std::memory_order_relaxed);
+
+ RasterWaitFor(wp + 1 - RasterRingSize);
+
+ return &RasterRing[wp % RasterRingSize];
+}
+
+static void RasterCaptureEnv(RasterEnv &env)
+{
+ env.ClipX0 = ClipX0;
+ env.ClipY0 = ClipY0;
+ env.ClipX1 = ClipX1;
+ env.ClipY1 = ClipY1;
+
+ env.OffsX = OffsX;
+ env.OffsY = OffsY;
+
+ env.MaskSetOR = MaskSetOR;
+ env.MaskEvalAND = MaskEvalAND;
+
+ env.TWX_AND = SUCV.TWX_AND;
+ env.TWX_ADD = SUCV.TWX_ADD;
+ env.TWY_AND = SUCV.TWY_AND;
+ env.TWY_ADD = SUCV.TWY_ADD;
+
+ env.SpriteFlip = SpriteFlip;
+ env.abr = abr;
+ env.TexMode = TexMode;
+
+ env.DisplayMode = DisplayMode;
+ env.DisplayFB_YStart = DisplayFB_YStart;
+
+ env.dtd = dtd;
+ env.dfe = dfe;
+ env.field_ram_readout = field_ram_readout;
+
+ env.InCmd = InCmd;
+ memcpy(env.InQuad_F3Vertices, InQuad_F3Vertices, sizeof(env.InQuad_F3Vertices));
+ env.InPLine_PrevPoint = InPLine_PrevPoint;
+
+ env.FBRW_X = FBRW_X;
+ env.FBRW_Y = FBRW_Y;
+ env.FBRW_W = FBRW_W;
+ env.FBRW_H = FBRW_H;
+ env.FBRW_CurX = FBRW_CurX;
+ env.FBRW_CurY = FBRW_CurY;
+}
+
+static void RasterQueueDraw(const uint32 cc, const uint32 *cb, const unsigned len)
+{
+ RasterCmd *rc = RasterAlloc();
+
+ rc->type = RasterCmd::TYPE_DRAW;
+ rc->cc = cc;
+ rc->count = len;
+ memcpy(rc->cb, cb, len * sizeof(uint32));
+ RasterCaptureEnv(rc->env);
+
+ RasterCommit();
+}
+
+static void RasterQueueFBWrite(const uint32 InData)
+{
+ if(!RasterStage)
+ {
+  RasterStage = RasterAlloc();
+  RasterStage->type = RasterCmd::TYPE_FBWRITE;
+  RasterStage->count = 0;
+  RasterCaptureEnv(RasterStage->env);
+ }
+
+ RasterStage->cb[RasterStage->count++] = InData;
+
+ if(RasterStage->count == 0x10)
+  RasterFlushStage();
+}
+
+static void RasterQueueInvalidate(const bool clut)
+{
+ RasterCmd *rc = RasterAlloc();
+
+ rc->type = RasterCmd::TYPE_INVALIDATE;
+ rc->cc = clut;
+
+ RasterCommit();
+}
+
+void GPU_Sync(void)
+{
+ if(!RasterDeferred)
+  return;
+
+ RasterFlushStage();
+ RasterWaitFor(RasterWritePos.load(std::memory_order_relaxed));
+}
+
+void GPU_SetThreaded(bool threaded)
+{
+ if(threaded == RasterDeferred)
+  return;
+
+ if(threaded)
+ {
+  GPU_RasterLoadCaches();
+
+  RasterQuit = false;
+  RasterThread = std::thread(RasterThreadMain);
+  RasterDeferred = true;
+ }
+ else
+ {
+  GPU_Sync();
+  GPU_RasterStoreCaches();
+
+  {
+   std::lock_guard<std::mutex> lock(RasterMutex);
+   RasterQuit = true;
+   RasterWorkCond.notify_one();
+  }
+  RasterThread.join();
+  RasterDeferred = false;
+ }
 }
 
 /*
@@ -240,12 +462,18 @@ static INLINE void InvalidateTexCache(void)
 {
  for(auto& c : TexCache)
   c.Tag = ~0U;
+
+ if(RasterDeferred)
+  RasterQueueInvalidate(false);
 }
 
 static void InvalidateCache(void)
 {
  CLUT_Cache_VB = ~0U;
 
+ if(RasterDeferred)
+  RasterQueueInvalidate(true);
+
  InvalidateTexCache();
 }
 
@@ -319,6 +547,8 @@ static void SoftReset(void) // Control command 0x00
 
 void GPU_Power(void)
 {
+ GPU_Sync();
+
  memset(GPURAM, 0, sizeof(GPURAM));
 
  memset(CLUT_Cache, 0, sizeof(CLUT_Cache));
@@ -415,6 +645,12 @@ void GPU_Power(void)
 
  IRQ_Assert(IRQ_VBLANK, InVBlank);
  TIMER_SetVBlank(InVBlank);
+
+ if(RasterDeferred)
+ {
+  GPU_Sync();
+  GPU_RasterLoadCaches();
+ }
 }
 
 void GPU_ResetTS(void)
@@ -448,6 +684,9 @@ static void Command_FBFill(const uint32 *cb)
 
   DrawTimeAvail -= (width >> 3) + 9;
 
+  if(RasterDeferred)
+   continue;
+
   for(int32 x = 0; x < width; x++)
   {
    const int32 d_x = (x + destX) & 1023;
@@ -478,6 +717,9 @@ static void Command_FBCopy(const uint32 *cb)
 
  DrawTimeAvail -= (width * height) * 2;
 
+ if(RasterDeferred)
+  return;
+
  for(int32 y = 0; y < height; y++)
  {
   for(int32 x = 0; x < width; x += 128)
@@ -538,6 +780,9 @@ static void Command_FBRead(const uint32 *cb)
 {
  assert(InCmd == PS_GPU::INCMD_NONE);
 
+ // Nothing else can write VRAM until the read completes, so one sync here covers ReadData() and GPU_ReadDMA().
+ GPU_Sync();
+
  FBRW_X = (cb[1] >>  0) & 0x3FF;
  FBRW_Y = (cb[1] >> 16) & 0x3FF;
 
@@ -715,6 +960,14 @@ MDFN_HIDE extern const CTEntry Commands_80_FF[0x80] =
 };
 }
 
+static INLINE void RunCommand(const CTEntry *command, const uint32 cc, const uint32 *CB, const unsigned len)
+{
+ if(RasterDeferred && (cc == 0x02 || (cc >= 0x20 && cc < 0xA0)))
+  RasterQueueDraw(cc, CB, len);
+
+ command->func[abr][TexMode | (MaskEvalAND ? 0x4 : 0x0)](CB);
+}
+
 static void ProcessFIFO(void)
 {
  if(!BlitterFIFO.CanRead())
@@ -737,9 +990,12 @@ static void ProcessFIFO(void)
        {
   	uint32 InData = BlitterFIFO.Read();
 
+	if(RasterDeferred)
+	 RasterQueueFBWrite(InData);
+
   	for(int i = 0; i < 2; i++)
   	{
-   	 if(!(GPURAM[FBRW_CurY & 511][FBRW_CurX & 1023] & MaskEvalAND))
+   	 if(!RasterDeferred && !(GPURAM[FBRW_CurY & 511][FBRW_CurX & 1023] & MaskEvalAND))
     	  GPURAM[FBRW_CurY & 511][FBRW_CurX & 1023] = InData | MaskSetOR;
 
 	 FBRW_CurX++;
@@ -776,7 +1032,7 @@ static void ProcessFIFO(void)
 	  CB[i] = BlitterFIFO.Read();
 	 }
 
-	 command->func[abr][TexMode | (MaskEvalAND ? 0x4 : 0x0)](CB);
+	 RunCommand(command, cc, CB, vl);
 	}
 	return;
        }
@@ -806,7 +1062,7 @@ static void ProcessFIFO(void)
 	  CB[i] = BlitterFIFO.Read();
 	 }
 
-	 command->func[abr][TexMode | (MaskEvalAND ? 0x4 : 0x0)](CB);
+	 RunCommand(command, cc, CB, vl);
 	}
 	return;
        }
@@ -855,7 +1111,7 @@ static void ProcessFIFO(void)
   }
   else
   {
-   command->func[abr][TexMode | (MaskEvalAND ? 0x4 : 0x0)](CB);
+   RunCommand(command, cc, CB, command->len);
   }
  }
 }
@@ -1145,6 +1401,27 @@ static NO_INLINE void ReorderRGB(bool bpp24, const uint16 *src, uint32 *dest, co
 }
 #pragma GCC pop_options
 
+static void ReadoutLine(const uint16 *src, uint32 *dest, const MDFN_PixelFormat &format, bool bpp24, int32 dx_start, int32 dx_end, uint32 dmw, int32 fb_x, uint32 black)
+{
+ for(int32 x = 0; x < dx_start; x++)
+  dest[x] = black;
+
+ //printf("%d %d %d - %d %d\n", scanline, dx_start, dx_end, HorizStart, HorizEnd);
+ if(format.Rshift == 0 && format.Gshift == 8 && format.Bshift == 16)
+  ReorderRGB<0, 8, 16>(bpp24, src, dest, dx_start, dx_end, fb_x);
+ else if(format.Rshift == 8 && format.Gshift == 16 && format.Bshift == 24)
+  ReorderRGB<8, 16, 24>(bpp24, src, dest, dx_start, dx_end, fb_x);
+ else if(format.Rshift == 16 && format.Gshift == 8 && format.Bshift == 0)
+  ReorderRGB<16, 8, 0>(bpp24, src, dest, dx_start, dx_end, fb_x);
+ else if(format.Rshift == 24 && format.Gshift == 16 && format.Bshift == 8)
+  ReorderRGB<24, 16, 8>(bpp24, src, dest, dx_start, dx_end, fb_x);
+ else
+  ReorderRGB_Var(format.Rshift, format.Gshift, format.Bshift, bpp24, src, dest, dx_start, dx_end, fb_x);
+
+ for(uint32 x = dx_end; x < dmw; x++)
+  dest[x] = black;
+}
+
 MDFN_FASTCALL pscpu_timestamp_t GPU_Update(const pscpu_timestamp_t sys_timestamp)
 {
  const uint32 dmc = (DisplayMode & 0x40) ? 4 : (DisplayMode & 0x3);
@@ -1256,6 +1533,10 @@ MDFN_FASTCALL pscpu_timestamp_t GPU_Update(const pscpu_timestamp_t sys_timestamp
      assert(sl_zero_reached == false);
      sl_zero_reached = true;
 
+     // The surface setup below can overlap columns a queued display line is still being written to.
+     if(espec)
+      GPU_Sync();
+
      if(DisplayMode & 0x20)
      {
       skip = false;
@@ -1436,26 +1717,28 @@ MDFN_FASTCALL pscpu_timestamp_t GPU_Update(const pscpu_timestamp_t sys_timestamp
       dest += nca_dest_adj;
      }
 
+     // Lightguns look at the line's pixels from PSX_GPULineHook(), so it can't be left to the raster thread then.
+     if(RasterDeferred && !PSX_GPULineHookNeedsPixels())
      {
-      const uint16 *src = GPURAM[DisplayFB_CurLineYReadout];
-
-      for(int32 x = 0; x < dx_start; x++)
-       dest[x] = black;
-
-      //printf("%d %d %d - %d %d\n", scanline, dx_start, dx_end, HorizStart, HorizEnd);
-      if(surface->format.Rshift == 0 && surface->format.Gshift == 8 && surface->format.Bshift == 16)
-       ReorderRGB<0, 8, 16>(DisplayMode & 0x10, src, dest, dx_start, dx_end, fb_x);
-      else if(surface->format.Rshift == 8 && surface->format.Gshift == 16 && surface->format.Bshift == 24)
-       ReorderRGB<8, 16, 24>(DisplayMode & 0x10, src, dest, dx_start, dx_end, fb_x);
-      else if(surface->format.Rshift == 16 && surface->format.Gshift == 8 && surface->format.Bshift == 0)
-       ReorderRGB<16, 8, 0>(DisplayMode & 0x10, src, dest, dx_start, dx_end, fb_x);
-      else if(surface->format.Rshift == 24 && surface->format.Gshift == 16 && surface->format.Bshift == 8)
-       ReorderRGB<24, 16, 8>(DisplayMode & 0x10, src, dest, dx_start, dx_end, fb_x);
-      else
-       ReorderRGB_Var(surface->format.Rshift, surface->format.Gshift, surface->format.Bshift, DisplayMode & 0x10, src, dest, dx_start, dx_end, fb_x);
-
-      for(uint32 x = dx_end; x < dmw; x++)
-       dest[x] = black;
+      RasterCmd *rc = RasterAlloc();
+
+      rc->type = RasterCmd::TYPE_SCANOUT;
+      rc->scanout.src = GPURAM[DisplayFB_CurLineYReadout];
+      rc->scanout.dest = dest;
+      rc->scanout.format = &surface->format;
+      rc->scanout.bpp24 = DisplayMode & 0x10;
+      rc->scanout.dx_start = dx_start;
+      rc->scanout.dx_end = dx_end;
+      rc->scanout.dmw = dmw;
+      rc->scanout.fb_x = fb_x;
+      rc->scanout.black = black;
+
+      RasterCommit();
+     }
+     else
+     {
+      GPU_Sync();
+      ReadoutLine(GPURAM[DisplayFB_CurLineYReadout], dest, surface->format, DisplayMode & 0x10, dx_start, dx_end, dmw, fb_x, black);
      }
 
      //if(scanline == 64)
@@ -1567,6 +1850,11 @@ void GPU_StartFrame(EmulateSpecStruct *espec_arg)
 
 SYNCFUNC(PS_GPU)
 {
+	//BIZHAWK: with threaded rasterization, VRAM and the cache contents are only current once the raster thread catches up
+	GPU_Sync();
+	if(RasterDeferred && !isReader)
+		GPU_RasterStoreCaches();
+
 	NSS(GPURAM);
 
 	NSS(CLUT_Cache);
@@ -1690,6 +1978,9 @@ SYNCFUNC(PS_GPU)
 		OffsY = sign_x_to_s32(11, OffsY);
 
 		IRQ_Assert(IRQ_GPU, IRQPending);
+
+		if(RasterDeferred)
+			GPU_RasterLoadCaches();
 	}
 
 }
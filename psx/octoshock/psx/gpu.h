@@ -56,6 +56,70 @@ struct line_point
  uint8 r, g, b;
 };
 
+//
+// Threaded rasterization(see GPU_SetThreaded()).  The emulation thread still runs every command for its timing and
+// cache-tag side effects, but leaves VRAM alone and queues one of these for the raster thread instead.
+//
+struct RasterEnv	// Drawing state a queued command runs against.
+{
+ int32 ClipX0, ClipY0, ClipX1, ClipY1;
+ int32 OffsX, OffsY;
+
+ uint32 MaskSetOR;
+ uint32 MaskEvalAND;
+
+ uint32 TWX_AND, TWX_ADD;
+ uint32 TWY_AND, TWY_ADD;
+
+ uint32 SpriteFlip;
+ uint32 abr;
+ uint32 TexMode;
+
+ uint32 DisplayMode;
+ uint32 DisplayFB_YStart;
+
+ bool dtd;
+ bool dfe;
+ bool field_ram_readout;
+
+ uint8 InCmd;
+ tri_vertex InQuad_F3Vertices[3];
+ line_point InPLine_PrevPoint;
+
+ uint32 FBRW_X, FBRW_Y, FBRW_W, FBRW_H;
+ uint32 FBRW_CurX, FBRW_CurY;
+};
+
+struct RasterCmd
+{
+ enum
+ {
+  TYPE_DRAW = 0,	// FB fill/copy, polygon, line or sprite; cc and cb[0..count)
+  TYPE_FBWRITE,		// FB write data words cb[0..count), starting at env FBRW_Cur*
+  TYPE_INVALIDATE,	// Texture cache invalidation, or CLUT cache invalidation if cc != 0
+  TYPE_SCANOUT		// Display line readout into the output surface
+ };
+
+ uint8 type;
+ uint8 cc;
+ uint8 count;
+
+ uint32 cb[0x10];
+ RasterEnv env;
+
+ struct
+ {
+  const uint16 *src;
+  uint32 *dest;
+  const MDFN_PixelFormat *format;
+  int32 dx_start, dx_end;
+  uint32 dmw;
+  int32 fb_x;
+  uint32 black;
+  bool bpp24;
+ } scanout;
+};
+
 struct PS_GPU
 {
  
@@ -188,6 +252,8 @@ struct PS_GPU
 
  int32 DrawTimeAvail;
 
+ bool RasterDeferred;	// Pixel work goes to the raster thread; only timing and cache tags are updated inline.
+
  pscpu_timestamp_t lastts;
 
  uint8 DitherLUT[4][4][512];	// Y, X, 8-bit source value(256 extra for saturation)
@@ -240,6 +306,15 @@ struct PS_GPU
 
  MDFN_FASTCALL pscpu_timestamp_t GPU_Update(const pscpu_timestamp_t timestamp);
 
+ void GPU_SetThreaded(bool threaded) MDFN_COLD;
+
+ // Waits for the raster thread to finish all queued work, so that VRAM and the output surface are current.
+ void GPU_Sync(void);
+
+ void GPU_RasterExec(const RasterCmd& rc);	// gpu_raster.cpp
+ void GPU_RasterLoadCaches(void);
+ void GPU_RasterStoreCaches(void);
+
  MDFN_FASTCALL void GPU_Write(const pscpu_timestamp_t timestamp, uint32 A, uint32 V);
 
  static INLINE bool GPU_CalcFIFOReadyBit(void)
@@ -179,6 +179,19 @@ static INLINE void DrawSpan(int y, const int32 x_start, const int32 x_bound, i_g
   else
    DrawTimeAvail -= w;
 
+  if(RasterDeferred)
+  {
+   if(textured)
+   {
+    do
+    {
+     TouchTexel<TexMode_TA>(ig.u >> (COORD_FBS + COORD_POST_PADDING), ig.v >> (COORD_FBS + COORD_POST_PADDING));
+     AddIDeltas_DX<goraud, textured>(ig, idl);
+    } while(MDFN_LIKELY(--w > 0));
+   }
+   return;
+  }
+
   do
   {
    const uint32 r = ig.r >> (COORD_FBS + COORD_POST_PADDING);
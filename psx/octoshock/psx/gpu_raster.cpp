@@ -0,0 +1,241 @@
+//BIZHAWK: second build of the rasterizers, run by the raster thread when threaded rasterization is on(see GPU_SetThreaded()).
+//gpu_common.inc binds everything here to GPU_Raster, the thread's private copy of the drawing state and caches, except
+//for VRAM and the dither table, which are shared with the emulation thread.
+//The emulation thread runs the same commands first for their timing, so nothing here may touch GPU itself apart from VRAM.
+
+#define PSX_GPU_RASTER_WORKER 1
+
+#include "psx.h"
+#include "gpu.h"
+
+namespace MDFN_IEN_PSX
+{
+ MDFN_HIDE extern PS_GPU GPU_Raster;
+}
+
+#include "gpu_polygon.cpp"
+#include "gpu_line.cpp"
+#include "gpu_sprite.cpp"
+
+namespace MDFN_IEN_PSX
+{
+
+PS_GPU GPU_Raster;
+
+namespace PS_GPU_INTERNAL
+{
+
+static void ApplyEnv(const RasterEnv& env)
+{
+ ClipX0 = env.ClipX0;
+ ClipY0 = env.ClipY0;
+ ClipX1 = env.ClipX1;
+ ClipY1 = env.ClipY1;
+
+ OffsX = env.OffsX;
+ OffsY = env.OffsY;
+
+ MaskSetOR = env.MaskSetOR;
+ MaskEvalAND = env.MaskEvalAND;
+
+ SUCV.TWX_AND = env.TWX_AND;
+ SUCV.TWX_ADD = env.TWX_ADD;
+ SUCV.TWY_AND = env.TWY_AND;
+ SUCV.TWY_ADD = env.TWY_ADD;
+
+ SpriteFlip = env.SpriteFlip;
+ abr = env.abr;
+ TexMode = env.TexMode;
+
+ DisplayMode = env.DisplayMode;
+ DisplayFB_YStart = env.DisplayFB_YStart;
+
+ dtd = env.dtd;
+ dfe = env.dfe;
+ field_ram_readout = env.field_ram_readout;
+
+ InCmd = env.InCmd;
+ memcpy(InQuad_F3Vertices, env.InQuad_F3Vertices, sizeof(InQuad_F3Vertices));
+ InPLine_PrevPoint = env.InPLine_PrevPoint;
+
+ FBRW_X = env.FBRW_X;
+ FBRW_Y = env.FBRW_Y;
+ FBRW_W = env.FBRW_W;
+ FBRW_H = env.FBRW_H;
+ FBRW_CurX = env.FBRW_CurX;
+ FBRW_CurY = env.FBRW_CurY;
+
+ // Timing was already accounted for on the emulation thread; just keep this from running off.
+ DrawTimeAvail = 0;
+}
+
+//
+// Pixel halves of Command_FBFill() and Command_FBCopy() in gpu.cpp.
+//
+static void FBFill(const uint32 *cb)
+{
+ int32 r = cb[0] & 0xFF;
+ int32 g = (cb[0] >> 8) & 0xFF;
+ int32 b = (cb[0] >> 16) & 0xFF;
+ const uint16 fill_value = ((r >> 3) << 0) | ((g >> 3) << 5) | ((b >> 3) << 10);
+
+ int32 destX = (cb[1] >>  0) & 0x3F0;
+ int32 destY = (cb[1] >> 16) & 0x3FF;
+
+ int32 width =  (((cb[2] >> 0) & 0x3FF) + 0xF) & ~0xF;
+ int32 height = (cb[2] >> 16) & 0x1FF;
+
+ for(int32 y = 0; y < height; y++)
+ {
+  const int32 d_y = (y + destY) & 511;
+
+  if(LineSkipTest(d_y))
+   continue;
+
+  for(int32 x = 0; x < width; x++)
+  {
+   const int32 d_x = (x + destX) & 1023;
+
+   GPURAM[d_y][d_x] = fill_value;
+  }
+ }
+}
+
+static void FBCopy(const uint32 *cb)
+{
+ int32 sourceX = (cb[1] >> 0) & 0x3FF;
+ int32 sourceY = (cb[1] >> 16) & 0x3FF;
+ int32 destX = (cb[2] >> 0) & 0x3FF;
+ int32 destY = (cb[2] >> 16) & 0x3FF;
+
+ int32 width = (cb[3] >> 0) & 0x3FF;
+ int32 height = (cb[3] >> 16) & 0x1FF;
+
+ if(!width)
+  width = 0x400;
+
+ if(!height)
+  height = 0x200;
+
+ for(int32 y = 0; y < height; y++)
+ {
+  for(int32 x = 0; x < width; x += 128)
+  {
+   const int32 chunk_x_max = std::min<int32>(width - x, 128);
+   uint16 tmpbuf[128];
+
+   for(int32 chunk_x = 0; chunk_x < chunk_x_max; chunk_x++)
+   {
+    int32 s_y = (y + sourceY) & 511;
+    int32 s_x = (x + chunk_x + sourceX) & 1023;
+
+    tmpbuf[chunk_x] = GPURAM[s_y][s_x];
+   }
+
+   for(int32 chunk_x = 0; chunk_x < chunk_x_max; chunk_x++)
+   {
+    int32 d_y = (y + destY) & 511;
+    int32 d_x = (x + chunk_x + destX) & 1023;
+
+    if(!(GPURAM[d_y][d_x] & MaskEvalAND))
+     GPURAM[d_y][d_x] = tmpbuf[chunk_x] | MaskSetOR;
+   }
+  }
+ }
+}
+
+// Replays the INCMD_FBWRITE case of ProcessFIFO().
+static void FBWrite(const uint32 *cb, const unsigned count)
+{
+ for(unsigned w = 0; w < count; w++)
+ {
+  uint32 InData = cb[w];
+
+  for(int i = 0; i < 2; i++)
+  {
+   if(!(GPURAM[FBRW_CurY & 511][FBRW_CurX & 1023] & MaskEvalAND))
+    GPURAM[FBRW_CurY & 511][FBRW_CurX & 1023] = InData | MaskSetOR;
+
+   FBRW_CurX++;
+   if(FBRW_CurX == (FBRW_X + FBRW_W))
+   {
+    FBRW_CurX = FBRW_X;
+    FBRW_CurY++;
+    if(FBRW_CurY == (FBRW_Y + FBRW_H))
+     return;
+   }
+   InData >>= 16;
+  }
+ }
+}
+
+}
+
+using namespace PS_GPU_INTERNAL;
+
+void GPU_RasterExec(const RasterCmd& rc)
+{
+ switch(rc.type)
+ {
+  case RasterCmd::TYPE_INVALIDATE:
+	if(rc.cc)
+	 CLUT_Cache_VB = ~0U;
+	else
+	{
+	 for(auto& c : TexCache)
+	  c.Tag = ~0U;
+	}
+	break;
+
+  case RasterCmd::TYPE_FBWRITE:
+	ApplyEnv(rc.env);
+	FBWrite(rc.cb, rc.count);
+	break;
+
+  case RasterCmd::TYPE_DRAW:
+       {
+	const uint32 cc = rc.cc;
+
+	ApplyEnv(rc.env);
+
+	if(cc == 0x02)
+	 FBFill(rc.cb);
+	else if(cc >= 0x80)
+	 FBCopy(rc.cb);
+	else
+	{
+	 const CTEntry *command;
+
+	 if(cc >= 0x60)
+	  command = &RasterCommands_60_7F[cc - 0x60];
+	 else if(cc >= 0x40)
+	  command = &RasterCommands_40_5F[cc - 0x40];
+	 else
+	  command = &RasterCommands_20_3F[cc - 0x20];
+
+	 command->func[abr][TexMode | (MaskEvalAND ? 0x4 : 0x0)](rc.cb);
+	}
+       }
+       break;
+ }
+}
+
+//
+// Only valid while the raster thread is idle(not started yet, or after GPU_Sync()).  The cache tags are kept in
+// lockstep on both threads, but only this side fills in the data while threaded.
+//
+void GPU_RasterLoadCaches(void)
+{
+ memcpy(GPU_Raster.CLUT_Cache, GPU.CLUT_Cache, sizeof(GPU.CLUT_Cache));
+ GPU_Raster.CLUT_Cache_VB = GPU.CLUT_Cache_VB;
+ memcpy(GPU_Raster.TexCache, GPU.TexCache, sizeof(GPU.TexCache));
+}
+
+void GPU_RasterStoreCaches(void)
+{
+ memcpy(GPU.CLUT_Cache, GPU_Raster.CLUT_Cache, sizeof(GPU.CLUT_Cache));
+ GPU.CLUT_Cache_VB = GPU_Raster.CLUT_Cache_VB;
+ memcpy(GPU.TexCache, GPU_Raster.TexCache, sizeof(GPU.TexCache));
+}
+
+}
@@ -120,26 +120,40 @@ static void DrawSprite(int32 x_arg, int32 y_arg, int32 w, int32 h, uint8 u_arg,
     DrawTimeAvail -= suck_time;
    }
 
-   for(int32 x = x_start; MDFN_LIKELY(x < x_bound); x++)
+   if(RasterDeferred)
    {
     if(textured)
     {
-     uint16 fbw = GetTexel<TexMode_TA>(u_r, v);
-
-     if(fbw)
+     for(int32 x = x_start; MDFN_LIKELY(x < x_bound); x++)
      {
-      if(TexMult)
+      TouchTexel<TexMode_TA>(u_r, v);
+      u_r += u_inc;
+     }
+    }
+   }
+   else
+   {
+    for(int32 x = x_start; MDFN_LIKELY(x < x_bound); x++)
+    {
+     if(textured)
+     {
+      uint16 fbw = GetTexel<TexMode_TA>(u_r, v);
+
+      if(fbw)
       {
-       fbw = ModTexel(fbw, r, g, b, 3, 2);
+       if(TexMult)
+       {
+        fbw = ModTexel(fbw, r, g, b, 3, 2);
+       }
+       PlotPixel<BlendMode, MaskEval_TA, true>(x, y, fbw);
       }
-      PlotPixel<BlendMode, MaskEval_TA, true>(x, y, fbw);
      }
-    }
-    else
-     PlotPixel<BlendMode, MaskEval_TA, false>(x, y, fill_color);
+     else
+      PlotPixel<BlendMode, MaskEval_TA, false>(x, y, fill_color);
 
-    if(textured)
-     u_r += u_inc;
+     if(textured)
+      u_r += u_inc;
+    }
    }
   }
   if(textured)
@@ -1018,6 +1018,11 @@ void PSX_GPULineHook(const pscpu_timestamp_t timestamp, const pscpu_timestamp_t
  FIO->GPULineHook(timestamp, line_timestamp, vsync, pixels, format, width, pix_clock_offset, pix_clock, pix_clock_divider);
 }
 
+bool PSX_GPULineHookNeedsPixels(void)
+{
+ return FIO->RequireNoFrameskip();
+}
+
 }
 
 using namespace MDFN_IEN_PSX;
@@ -1362,6 +1367,10 @@ static bool s_Created;
 static int s_FramebufferCurrent;
 static int s_FramebufferCurrentWidth;
 
+//state as of the last delta transaction, and the scratch buffer deltas are built in
+static std::vector<unsigned char> s_DeltaRef;
+static std::vector<unsigned char> s_DeltaScratch;
+
 EW_EXPORT s32 shock_Create(void** psx, s32 region, void* firmware512k)
 {
 	#ifdef SHOCK_RUN_TESTS
@@ -1488,6 +1497,9 @@ EW_EXPORT s32 shock_Destroy(void* psx)
 
 	cdifs = NULL;
 
+	s_DeltaRef.clear();
+	s_DeltaScratch.clear();
+
 	return SHOCK_OK;
 }
 
@@ -1572,6 +1584,7 @@ EW_EXPORT s32 shock_Step(void* psx, eShockStep step)
 	assert(timestamp);
 
 	ForceEventUpdates(timestamp);
+	GPU_Sync();
 	if(GPU_GetScanlineNum() < 100)
 		printf("[BUUUUUUUG] Frame timing end glitch; scanline=%u, st=%u\n", GPU_GetScanlineNum(), timestamp);
 
@@ -2633,7 +2646,7 @@ EW_EXPORT s32 shock_GetMemData(void* psx, void** ptr, s32* size, s32 memType)
 	case eMemType_MainRAM: *ptr = MainRAM.data8; *size = 2048*1024; break;
 	case eMemType_BiosROM: *ptr = BIOSROM->data8; *size = 512*1024; break;
 	case eMemType_PIOMem: *ptr = PIOMem->data8; *size = 64*1024; break;
-	case eMemType_GPURAM: *ptr = GPU.GPURAM; *size = 2*512*1024; break;
+	case eMemType_GPURAM: GPU_Sync(); *ptr = GPU.GPURAM; *size = 2*512*1024; break;
 	case eMemType_SPURAM: *ptr = SPU->SPURAM; *size = 512*1024; break;
 	case eMemType_DCache: *ptr = CPU->debug_GetScratchRAMPtr(); *size = 1024; break;
 	default:
@@ -2726,6 +2739,50 @@ SYNCFUNC(PSX)
 	}
 }
 
+static s32 _shock_DeltaSave(ShockStateTransaction* transaction)
+{
+	bool keyframe = s_DeltaRef.empty();
+	{
+		EW::NewStateXorDelta saver(s_DeltaRef, s_DeltaScratch);
+		s_PSX.SyncState<false>(&saver);
+		if(!saver.Finish())
+		{
+			//the state length changed under us, so the reference is useless. start over with a keyframe
+			s_DeltaRef.clear();
+			keyframe = true;
+			EW::NewStateXorDelta rekey(s_DeltaRef, s_DeltaScratch);
+			s_PSX.SyncState<false>(&rekey);
+			rekey.Finish();
+		}
+	}
+
+	if(transaction->buffer == NULL || (long)s_DeltaScratch.size() > transaction->bufferLength)
+	{
+		//put the reference back how it was; the caller can retry with a bigger buffer
+		if(keyframe)
+			s_DeltaRef.clear();
+		else
+			EW::NewStateXorDelta::Apply(s_DeltaRef, &s_DeltaScratch[0], s_DeltaScratch.size());
+		return SHOCK_OVERFLOW;
+	}
+
+	memcpy(transaction->buffer, &s_DeltaScratch[0], s_DeltaScratch.size());
+	return (s32)s_DeltaScratch.size();
+}
+
+static s32 _shock_DeltaLoad(ShockStateTransaction* transaction)
+{
+	if(transaction->buffer == NULL) return SHOCK_ERROR;
+	if(!EW::NewStateXorDelta::Apply(s_DeltaRef, transaction->buffer, transaction->bufferLength))
+		return SHOCK_ERROR;
+
+	EW::NewStateExternalBuffer loader((char*)&s_DeltaRef[0], s_DeltaRef.size());
+	s_PSX.SyncState<true>(&loader);
+	if(!loader.Overflow() && loader.GetLength() == (long)s_DeltaRef.size())
+		return SHOCK_OK;
+	else return SHOCK_ERROR;
+}
+
 EW_EXPORT s32 shock_StateTransaction(void *psx, ShockStateTransaction* transaction)
 {
 	switch(transaction->transaction)
@@ -2767,6 +2824,13 @@ EW_EXPORT s32 shock_StateTransaction(void *psx, ShockStateTransaction* transacti
 			return SHOCK_OK;
 		}
 		return SHOCK_ERROR;
+	case eShockStateTransaction_BinaryDeltaSave:
+		return _shock_DeltaSave(transaction);
+	case eShockStateTransaction_BinaryDeltaLoad:
+		return _shock_DeltaLoad(transaction);
+	case eShockStateTransaction_BinaryDeltaReset:
+		s_DeltaRef.clear();
+		return SHOCK_OK;
 
 	default:
 		return SHOCK_ERROR;
@@ -2833,6 +2897,12 @@ EW_EXPORT s32 shock_SetLEC(void* psx, bool enabled)
 	return SHOCK_OK;
 }
 
+EW_EXPORT s32 shock_SetGPUThreaded(void* psx, bool enabled)
+{
+	GPU_SetThreaded(enabled);
+	return SHOCK_OK;
+}
+
 //whether "determine lag from GPU frames" signal is set (GPU did something considered non-lag)
 //returns SHOCK_TRUE or SHOCK_FALSE
 EW_EXPORT s32 shock_GetGPUUnlagged(void* psx)
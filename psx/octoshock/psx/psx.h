@@ -111,6 +111,7 @@ namespace MDFN_IEN_PSX
  void PSX_SetDMACycleSteal(unsigned stealage);
 
  void PSX_GPULineHook(const pscpu_timestamp_t timestamp, const pscpu_timestamp_t line_timestamp, bool vsync, uint32 *pixels, const MDFN_PixelFormat* const format, const unsigned width, const unsigned pix_clock_offset, const unsigned pix_clock, const unsigned pix_clock_divider);
+ bool PSX_GPULineHookNeedsPixels(void);
 
  uint32 PSX_GetRandU32(uint32 mina, uint32 maxa);
 }
@@ -201,7 +202,16 @@ enum eShockStateTransaction : s32
 	eShockStateTransaction_BinaryLoad = 1,
 	eShockStateTransaction_BinarySave = 2,
 	eShockStateTransaction_TextLoad = 3,
-	eShockStateTransaction_TextSave = 4
+	eShockStateTransaction_TextSave = 4,
+
+	//XOR page deltas against the core's copy of the state at the previous delta transaction (see EW::NewStateXorDelta).
+	//DeltaSave returns the length of the delta written to the buffer, or SHOCK_OVERFLOW (leaving the reference untouched) if it didnt fit.
+	//the buffer never needs to be more than BinarySize + 16 + 4 bytes per 4KB page.
+	//DeltaLoad applies the delta and loads the resulting state, so feeding deltas back newest-first walks backwards.
+	//DeltaReset forgets the reference, so the next DeltaSave produces a self-contained keyframe.
+	eShockStateTransaction_BinaryDeltaSave = 5,
+	eShockStateTransaction_BinaryDeltaLoad = 6,
+	eShockStateTransaction_BinaryDeltaReset = 7
 };
 
 enum eShockMemcardTransaction
@@ -451,6 +461,10 @@ EW_EXPORT s32 shock_SetTraceCallback(void* psx, void* opaque, ShockCallback_Trac
 //Sets whether LEC is enabled (sector level error correction). Defaults to FALSE (disabled)
 EW_EXPORT s32 shock_SetLEC(void* psx, bool enabled);
 
+//Sets whether GPU pixel work (polygons, sprites, lines, VRAM fills/copies/uploads, display readout) runs on a worker thread. Defaults to FALSE (disabled)
+//Drawing timing is still worked out on the emulating thread, so emulation is identical either way.
+EW_EXPORT s32 shock_SetGPUThreaded(void* psx, bool enabled);
+
 //whether "determine lag from GPU frames" signal is set (GPU did something considered non-lag)
 //returns SHOCK_TRUE or SHOCK_FALSE
 EW_EXPORT s32 shock_GetGPUUnlagged(void* psx);
@@ -53,7 +53,10 @@ namespace BizHawk.Emulation.Cores.Sony.PSX
 			BinaryLoad = 1,
 			BinarySave = 2,
 			TextLoad = 3,
-			TextSave = 4
+			TextSave = 4,
+			BinaryDeltaSave = 5,
+			BinaryDeltaLoad = 6,
+			BinaryDeltaReset = 7,
 		}
 
 		public enum eShockMemcardTransaction
@@ -295,6 +298,9 @@ namespace BizHawk.Emulation.Cores.Sony.PSX
 		[DllImport(dd, CallingConvention = cc)]
 		public static extern int shock_SetLEC(IntPtr psx, bool enable);
 
+		[DllImport(dd, CallingConvention = cc)]
+		public static extern int shock_SetGPUThreaded(IntPtr psx, bool enable);
+
 		[DllImport(dd, CallingConvention = cc)]
 		public static extern int shock_GetGPUUnlagged(IntPtr psx);
 		